@@ -1,6 +1,7 @@
 ﻿#include "chess.h"
 #include <cmath>
 #include <algorithm>
+#include <iterator>
 
 // Проверка, свободен ли путь между текущей позицией и новой позицией
 bool Piece::isPathClear(Position newPos, const std::vector<std::unique_ptr<Piece>>& pieces) const {
@@ -180,9 +181,118 @@ std::unique_ptr<Piece> King::clone() const {
     return std::make_unique<King>(*this);
 }
 
+GameHistory::GameHistory()
+    : nodes(CAPACITY), line(CAPACITY), nextId(0), firstId(0), cursor(0), lineEnd(0) {
+    for (auto& node : nodes) {
+        node.id = NONE;
+    }
+}
+
+// Начать историю с указанной позиции. Узлы прошлой партии становятся недоступны
+void GameHistory::reset(const BoardSnapshot& start) {
+    firstId = nextId;
+    cursor = addNode(start, Position(), Position(), NONE, 0);
+    line[0] = cursor;
+    lineEnd = 0;
+}
+
+// Запись узла в арену поверх самого старого
+size_t GameHistory::addNode(const BoardSnapshot& snapshot, Position from, Position to, size_t parent, size_t ply) {
+    size_t id = nextId++;
+    HistoryNode& node = nodes[id % CAPACITY];
+    node.snapshot = snapshot;
+    node.from = from;
+    node.to = to;
+    node.id = id;
+    node.ply = ply;
+    node.parent = parent;
+    node.firstChild = NONE;
+    node.nextSibling = NONE;
+    node.selectedChild = NONE;
+    return id;
+}
+
+// Узел по номеру, если он относится к текущей партии и еще не затерт
+const HistoryNode* GameHistory::find(size_t id) const {
+    if (id == NONE || id < firstId) return nullptr;
+    const HistoryNode& node = nodes[id % CAPACITY];
+    return node.id == id ? &node : nullptr;
+}
+
+// Добавить ход после текущей позиции.
+// Прежние продолжения сохраняются как другие варианты, новый ход становится текущим
+void GameHistory::push(const BoardSnapshot& snapshot, Position from, Position to) {
+    // Новый узел может занять слот родителя, поэтому родителя обновляем заранее
+    HistoryNode& parent = nodes[cursor % CAPACITY];
+    size_t id = nextId;
+    size_t ply = parent.ply + 1;
+    size_t sibling = parent.firstChild;
+    parent.firstChild = id;
+    parent.selectedChild = id;
+
+    addNode(snapshot, from, to, cursor, ply);
+    nodes[id % CAPACITY].nextSibling = sibling;
+
+    cursor = id;
+    lineEnd = ply;
+    line[lineEnd % CAPACITY] = id;
+}
+
+// Продлить текущий вариант на один полуход по выбранному продолжению
+bool GameHistory::extendLine() {
+    const HistoryNode* last = find(line[lineEnd % CAPACITY]);
+    if (!last) return false;
+    const HistoryNode* next = find(last->selectedChild);
+    if (!next) return false;
+
+    ++lineEnd;
+    line[lineEnd % CAPACITY] = next->id;
+    return true;
+}
+
+// Перейти к полуходу текущего варианта.
+// Записанная часть варианта доступна сразу, дальше он достраивается по выбранным продолжениям
+bool GameHistory::goTo(size_t ply) {
+    while (lineEnd < ply) {
+        if (!extendLine()) return false;
+    }
+    if (ply + CAPACITY <= lineEnd) return false;
+
+    const HistoryNode* node = find(line[ply % CAPACITY]);
+    if (!node) return false;
+    cursor = node->id;
+    return true;
+}
+
+// Продолжение текущей позиции с номером index (0 - последнее добавленное)
+const HistoryNode* GameHistory::getVariation(size_t index) const {
+    const HistoryNode* child = find(nodes[cursor % CAPACITY].firstChild);
+    while (child && index > 0) {
+        child = find(child->nextSibling);
+        --index;
+    }
+    return child;
+}
+
+// Перейти к продолжению текущей позиции и сделать его текущим вариантом
+bool GameHistory::selectVariation(size_t index) {
+    const HistoryNode* child = getVariation(index);
+    if (!child) return false;
+
+    nodes[cursor % CAPACITY].selectedChild = child->id;
+    cursor = child->id;
+    lineEnd = child->ply;
+    line[lineEnd % CAPACITY] = cursor;
+    return true;
+}
+
 // Инициализация шахматной доски
-ChessBoard::ChessBoard() : currentTurn(Color::WHITE), gameOver(false) {
+ChessBoard::ChessBoard() : currentTurn(Color::WHITE), gameOver(false), positionVersion(1) {
+    // Резервируем память заранее, чтобы ходы и переходы по истории не выделяли ее
+    pieces.reserve(32);
+    capturedPieces.reserve(32);
     initializePieces();
+    history.reset(takeSnapshot());
 }
 
 // Начальная расстановка фигур
@@ -300,6 +410,60 @@ Position ChessBoard::getKingPosition(Color color) const {
     return Position(-1, -1); // Король не найден
 }
 
+// Временно выполнить ход для проверки позиции.
+// Взятая фигура убирается из списка, чтобы не учитывать ее атаки
+size_t ChessBoard::applyTemporaryMove(Piece* piece, Position to, std::unique_ptr<Piece>& captured) {
+    size_t capturedIndex = pieces.size();
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (pieces[i].get() != piece && pieces[i]->getPosition() == to) {
+            capturedIndex = i;
+            captured = std::move(pieces[i]);
+            pieces.erase(pieces.begin() + i);
+            break;
+        }
+    }
+    piece->setPosition(to);
+    return capturedIndex;
+}
+
+// Отменить временный ход и вернуть взятую фигуру на ее место в списке
+void ChessBoard::undoTemporaryMove(Piece* piece, Position from, std::unique_ptr<Piece>& captured, size_t capturedIndex) {
+    piece->setPosition(from);
+    if (captured) {
+        pieces.insert(pieces.begin() + capturedIndex, std::move(captured));
+    }
+}
+
+// Окончательное выполнение уже проверенного хода
+void ChessBoard::commitMove(Piece* piece, Position to, bool givesCheck, bool givesCheckmate) {
+    Position from = piece->getPosition();
+
+    // Убираем съеденную фигуру с доски, сохраняя ее для возврата по истории
+    for (auto it = pieces.begin(); it != pieces.end(); ++it) {
+        if ((*it)->getPosition() == to) {
+            capturedPieces.push_back(std::move(*it));
+            pieces.erase(it);
+            break;
+        }
+    }
+    piece->setPosition(to);
+
+    // Сообщаем о мате или шахе противнику
+    Color opponentColor = currentTurn == Color::WHITE ? Color::BLACK : Color::WHITE;
+    if (givesCheckmate) {
+        gameOver = true;
+        std::cout << (currentTurn == Color::WHITE ? "White" : "Black") << " МАТ " << std::endl;
+    }
+    else if (givesCheck) {
+        std::cout << (opponentColor == Color::WHITE ? "White" : "Black") << " ШАХ " << std::endl;
+    }
+
+    // Передаем ход другому игроку и запоминаем позицию в истории
+    currentTurn = opponentColor;
+    ++positionVersion;
+    history.push(takeSnapshot(), from, to);
+}
+
 // Основной метод для выполнения хода
 bool ChessBoard::movePiece(Position from, Position to) {
     if (gameOver) return false; // Игра уже окончена
@@ -311,16 +475,18 @@ bool ChessBoard::movePiece(Position from, Position to) {
     // Проверяем, допустим ли ход для этой фигуры
     if (!piece->isValidMove(to, pieces)) return false;
 
-    // Создаем временную копию фигуры для проверки
-    auto temp = piece->clone();
-    Piece* capturedPiece = getPieceAt(to);
-
     // Временно выполняем ход
-    piece->setPosition(to);
+    std::unique_ptr<Piece> captured;
+    size_t capturedIndex = applyTemporaryMove(piece, to, captured);
     bool inCheck = isCheck(currentTurn);
 
+    // Проверяем, не поставили ли мы шах или мат противнику
+    Color opponentColor = currentTurn == Color::WHITE ? Color::BLACK : Color::WHITE;
+    bool givesCheck = !inCheck && isCheck(opponentColor);
+    bool givesCheckmate = givesCheck && isCheckmate(opponentColor);
+
     // Отменяем временный ход
-    piece->setPosition(from);
+    undoTemporaryMove(piece, from, captured, capturedIndex);
 
     // Если ход ставит короля под шах, он недопустим
     if (inCheck) {
@@ -329,31 +495,149 @@ bool ChessBoard::movePiece(Position from, Position to) {
     }
 
     // Выполняем ход окончательно
-    piece->setPosition(to);
+    commitMove(piece, to, givesCheck, givesCheckmate);
+    return true;
+}
+
+// Выполнение хода, заранее рассчитанного в analyzePosition для текущей позиции
+bool ChessBoard::applyMove(const PositionAnalysis& analysis, const MoveInfo& move) {
+    if (gameOver) return false; // Игра уже окончена
+
+    // Анализ, выполненный для другой позиции, использовать нельзя
+    if (analysis.positionVersion != positionVersion) return false;
+
+    Piece* piece = getPieceAt(move.from);
+    if (!piece || piece->getColor() != currentTurn) return false;
 
-    // Удаляем съеденную фигуру, если она есть
-    if (capturedPiece) {
-        pieces.erase(
-            std::remove_if(pieces.begin(), pieces.end(),
-                [to](const std::unique_ptr<Piece>& p) {
-                    return p->getPosition() == to;
-                }),
-            pieces.end()
-        );
+    // Если ход ставит короля под шах, он недопустим
+    if (move.leavesKingInCheck) {
+        std::cout << "Ход поставит короля под шах" << std::endl;
+        return false;
     }
 
-    // Проверяем, не поставили ли мы мат противнику
+    commitMove(piece, move.to, move.givesCheck, move.givesCheckmate);
+    return true;
+}
+
+// Анализ позиции: все ходы текущего игрока и их последствия (шах/мат противнику).
+// Возвращает false, если анализ был прерван через флаг cancelled
+bool ChessBoard::analyzePosition(PositionAnalysis& result, const std::atomic<bool>& cancelled) {
+    result.moves.clear();
+    result.positionVersion = positionVersion;
+    if (gameOver) return true;
+
     Color opponentColor = currentTurn == Color::WHITE ? Color::BLACK : Color::WHITE;
-    if (isCheckmate(opponentColor)) {
-        gameOver = true;
-        std::cout << (currentTurn == Color::WHITE ? "White" : "Black") << " МАТ " << std::endl;
+
+    // Список фигур временно меняется при проверке взятий, поэтому обходим его по индексу
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        Piece* piece = pieces[i].get();
+        if (piece->getColor() != currentTurn) continue;
+
+        Position from = piece->getPosition();
+        for (int y = 0; y < 8; ++y) {
+            for (int x = 0; x < 8; ++x) {
+                if (cancelled) return false;
+
+                Position to(x, y);
+                if (!piece->isValidMove(to, pieces)) continue;
+
+                MoveInfo move;
+                move.from = from;
+                move.to = to;
+
+                // Временно выполняем ход и оцениваем получившуюся позицию
+                std::unique_ptr<Piece> captured;
+                size_t capturedIndex = applyTemporaryMove(piece, to, captured);
+                move.leavesKingInCheck = isCheck(currentTurn);
+                if (!move.leavesKingInCheck) {
+                    move.givesCheck = isCheck(opponentColor);
+                    move.givesCheckmate = move.givesCheck && isCheckmate(opponentColor);
+                }
+                undoTemporaryMove(piece, from, captured, capturedIndex);
+
+                result.moves.push_back(move);
+            }
+        }
     }
-    else if (isCheck(opponentColor)) {
-        std::cout << (opponentColor == Color::WHITE ? "White" : "Black") << " ШАХ " << std::endl;
+    return true;
+}
+
+// Найти ход среди рассчитанных анализом
+const MoveInfo* PositionAnalysis::findMove(Position from, Position to) const {
+    for (const auto& move : moves) {
+        if (move.from == from && move.to == to) {
+            return &move;
+        }
     }
+    return nullptr;
+}
 
-    // Передаем ход другому игроку
-    currentTurn = opponentColor;
+// Снимок текущей позиции
+BoardSnapshot ChessBoard::takeSnapshot() const {
+    BoardSnapshot snapshot;
+    std::fill(std::begin(snapshot.squares), std::end(snapshot.squares), '.');
+    for (const auto& piece : pieces) {
+        Position pos = piece->getPosition();
+        if (pos.isValid()) {
+            snapshot.squares[pos.y * 8 + pos.x] = piece->getSymbol();
+        }
+    }
+    snapshot.currentTurn = currentTurn;
+    snapshot.gameOver = gameOver;
+    return snapshot;
+}
+
+// Восстановление позиции из снимка.
+// Фигуры не создаются заново: все они убираются в запас и расставляются по снимку
+void ChessBoard::restoreSnapshot(const BoardSnapshot& snapshot) {
+    for (auto& piece : pieces) {
+        capturedPieces.push_back(std::move(piece));
+    }
+    pieces.clear();
+
+    for (int i = 0; i < 64; ++i) {
+        char symbol = snapshot.squares[i];
+        if (symbol == '.') continue;
+
+        // Берем из запаса любую фигуру с нужным символом
+        for (size_t j = 0; j < capturedPieces.size(); ++j) {
+            if (capturedPieces[j]->getSymbol() == symbol) {
+                capturedPieces[j]->setPosition(Position(i % 8, i / 8));
+                pieces.push_back(std::move(capturedPieces[j]));
+                capturedPieces[j] = std::move(capturedPieces.back());
+                capturedPieces.pop_back();
+                break;
+            }
+        }
+    }
+
+    currentTurn = snapshot.currentTurn;
+    gameOver = snapshot.gameOver;
+    ++positionVersion;
+}
+
+// Отменить последний ход
+bool ChessBoard::undoMove() {
+    size_t ply = history.getPly();
+    return ply > 0 && goToPly(ply - 1);
+}
+
+// Повторить отмененный ход
+bool ChessBoard::redoMove() {
+    return goToPly(history.getPly() + 1);
+}
+
+// Перейти к позиции после указанного полухода
+bool ChessBoard::goToPly(size_t ply) {
+    if (!history.goTo(ply)) return false;
+    restoreSnapshot(history.current());
+    return true;
+}
+
+// Перейти к продолжению текущей позиции с номером index
+bool ChessBoard::goToVariation(size_t index) {
+    if (!history.selectVariation(index)) return false;
+    restoreSnapshot(history.current());
     return true;
 }
 
@@ -399,33 +683,44 @@ bool ChessBoard::loadGame(const std::string& filename) {
     std::ifstream in(filename);
     if (!in) return false;
 
-    // Очищаем текущие фигуры
-    pieces.clear();
-
     // Читаем, чей ход
     std::string turn;
     in >> turn;
-    currentTurn = (turn == "white") ? Color::WHITE : Color::BLACK;
 
-    // Читаем фигуры и их позиции
+    // Читаем фигуры и их позиции. Текущая партия не меняется, пока файл не прочитан целиком
+    std::vector<std::unique_ptr<Piece>> loaded;
+    bool occupied[64] = {};
     char symbol;
     int x, y;
     while (in >> symbol >> x >> y) {
         Color color = isupper(symbol) ? Color::WHITE : Color::BLACK;
         Position pos(x, y);
 
+        // Позиция с фигурой за пределами доски или двумя фигурами на одной клетке недопустима
+        if (!pos.isValid() || occupied[pos.y * 8 + pos.x]) return false;
+
         // Создаем фигуры в соответствии с прочитанными данными
         switch (tolower(symbol)) {
-        case 'p': pieces.push_back(std::make_unique<Pawn>(color, pos)); break;
-        case 'r': pieces.push_back(std::make_unique<Rook>(color, pos)); break;
-        case 'n': pieces.push_back(std::make_unique<Knight>(color, pos)); break;
-        case 'b': pieces.push_back(std::make_unique<Bishop>(color, pos)); break;
-        case 'q': pieces.push_back(std::make_unique<Queen>(color, pos)); break;
-        case 'k': pieces.push_back(std::make_unique<King>(color, pos)); break;
-        default: break;
+        case 'p': loaded.push_back(std::make_unique<Pawn>(color, pos)); break;
+        case 'r': loaded.push_back(std::make_unique<Rook>(color, pos)); break;
+        case 'n': loaded.push_back(std::make_unique<Knight>(color, pos)); break;
+        case 'b': loaded.push_back(std::make_unique<Bishop>(color, pos)); break;
+        case 'q': loaded.push_back(std::make_unique<Queen>(color, pos)); break;
+        case 'k': loaded.push_back(std::make_unique<King>(color, pos)); break;
+        default: continue; // Неизвестный символ пропускаем
         }
+        occupied[pos.y * 8 + pos.x] = true;
     }
 
+    pieces = std::move(loaded);
+    currentTurn = (turn == "white") ? Color::WHITE : Color::BLACK;
+
+    // Загруженная позиция становится началом новой истории.
+    // Запас взятых фигур вмещает все фигуры, чтобы переходы по истории не выделяли память
+    capturedPieces.clear();
+    capturedPieces.reserve(pieces.size());
     gameOver = false;
+    ++positionVersion;
+    history.reset(takeSnapshot());
     return true;
 }
\ No newline at end of file
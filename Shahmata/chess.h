@@ -6,6 +6,7 @@
 #include <string>
 #include <memory>
 #include <fstream>
+#include <atomic>
 
 // Цвет фигур (белые/черные)
 enum class Color { WHITE, BLACK };
@@ -94,12 +95,84 @@ public:
     std::unique_ptr<Piece> clone() const override;
 };
 
+// Предварительно рассчитанный ход (результат фонового анализа позиции)
+struct MoveInfo {
+    Position from; // Откуда
+    Position to;   // Куда
+    bool leavesKingInCheck = false; // Ход оставляет своего короля под шахом (недопустим)
+    bool givesCheck = false;        // Ход ставит шах противнику
+    bool givesCheckmate = false;    // Ход ставит мат противнику
+};
+
+// Результат анализа позиции для игрока, который сейчас ходит
+struct PositionAnalysis {
+    std::vector<MoveInfo> moves; // Все ходы фигур текущего игрока, включая недопустимые из-за шаха
+    size_t positionVersion = 0;  // Версия позиции, для которой выполнен анализ
+
+    const MoveInfo* findMove(Position from, Position to) const; // Найти ход среди рассчитанных
+};
+
+// Компактный снимок позиции для истории партии
+struct BoardSnapshot {
+    char squares[64]; // Символы фигур по клеткам (индекс y * 8 + x), '.' - пустая клетка
+    Color currentTurn; // Чей ход
+    bool gameOver;     // Окончена ли игра
+};
+
+// Узел дерева вариантов: позиция и ход, который к ней привел
+struct HistoryNode {
+    BoardSnapshot snapshot; // Позиция после хода
+    Position from;          // Откуда был сделан ход
+    Position to;            // Куда был сделан ход
+    size_t id;              // Порядковый номер узла
+    size_t ply;             // Номер полухода
+    size_t parent;          // Предыдущая позиция
+    size_t firstChild;      // Последнее добавленное продолжение
+    size_t nextSibling;     // Более старое продолжение той же позиции
+    size_t selectedChild;   // Продолжение, по которому идет текущий вариант (для redo)
+};
+
+// История партии: дерево вариантов в арене узлов, память под которую выделяется один раз.
+// Арена работает как кольцо: при переполнении затираются самые старые узлы.
+// Ход, отмена, повтор и переход к полуходу текущего варианта выполняются за O(1)
+class GameHistory {
+public:
+    static const size_t CAPACITY = 1024; // Максимальное число хранимых позиций
+    static const size_t NONE = static_cast<size_t>(-1); // Отсутствующий узел
+
+private:
+    std::vector<HistoryNode> nodes; // Арена узлов (узел id хранится в слоте id % CAPACITY)
+    std::vector<size_t> line; // Узлы текущего варианта по полуходам (слот ply % CAPACITY)
+    size_t nextId;  // Номер следующего узла
+    size_t firstId; // Номер начальной позиции (более старые узлы принадлежат прошлой партии)
+    size_t cursor;  // Текущий узел
+    size_t lineEnd; // Последний полуход текущего варианта, записанный в line
+
+    size_t addNode(const BoardSnapshot& snapshot, Position from, Position to, size_t parent, size_t ply);
+    const HistoryNode* find(size_t id) const; // Узел по номеру, если он еще не затерт
+    bool extendLine(); // Продлить текущий вариант выбранным продолжением
+
+public:
+    GameHistory();
+
+    void reset(const BoardSnapshot& start); // Начать историю с указанной позиции
+    void push(const BoardSnapshot& snapshot, Position from, Position to); // Добавить ход после текущей позиции
+    bool goTo(size_t ply); // Перейти к полуходу текущего варианта
+    bool selectVariation(size_t index); // Перейти к продолжению текущей позиции с номером index
+    const HistoryNode* getVariation(size_t index) const; // Продолжение текущей позиции с номером index
+    const BoardSnapshot& current() const { return nodes[cursor % CAPACITY].snapshot; } // Текущая позиция
+    size_t getPly() const { return nodes[cursor % CAPACITY].ply; } // Номер текущего полухода
+};
+
 // Класс, представляющий шахматную доску и игровую логику
 class ChessBoard {
 private:
     std::vector<std::unique_ptr<Piece>> pieces; // Все фигуры на доске
     Color currentTurn; // Чей сейчас ход
     bool gameOver; // Флаг окончания игры
+    size_t positionVersion; // Увеличивается при каждом изменении позиции
+    std::vector<std::unique_ptr<Piece>> capturedPieces; // Взятые фигуры (для возврата по истории)
+    GameHistory history; // История позиций партии
 
     // Вспомогательные методы
     void initializePieces(); // Инициализация начальной расстановки фигур
@@ -109,15 +182,32 @@ private:
     bool isPositionUnderAttack(Position pos, Color attackingColor) const; // Под атакой ли позиция
     Position getKingPosition(Color color) const; // Получить позицию короля
 
+    // Временный ход для проверок (взятая фигура убирается с доски), возвращает индекс взятой фигуры
+    size_t applyTemporaryMove(Piece* piece, Position to, std::unique_ptr<Piece>& captured);
+    void undoTemporaryMove(Piece* piece, Position from, std::unique_ptr<Piece>& captured, size_t capturedIndex);
+    void commitMove(Piece* piece, Position to, bool givesCheck, bool givesCheckmate); // Завершение хода
+    BoardSnapshot takeSnapshot() const; // Снимок текущей позиции
+    void restoreSnapshot(const BoardSnapshot& snapshot); // Восстановить позицию из снимка
+
 public:
     ChessBoard();
 
     // Основные методы для управления игрой
     bool movePiece(Position from, Position to); // Сделать ход
+    bool applyMove(const PositionAnalysis& analysis, const MoveInfo& move); // Сделать ход, проверенный анализом текущей позиции
+    bool analyzePosition(PositionAnalysis& result, const std::atomic<bool>& cancelled); // Анализ позиции (false - прерван)
     void printBoard() const; // Отобразить доску
     bool isGameOver() const { return gameOver; } // Проверить, окончена ли игра
     Color getCurrentTurn() const { return currentTurn; } // Чей сейчас ход
 
+    // Навигация по истории партии
+    bool undoMove(); // Отменить последний ход
+    bool redoMove(); // Повторить отмененный ход
+    bool goToPly(size_t ply); // Перейти к позиции после указанного полухода
+    bool goToVariation(size_t index); // Перейти к продолжению текущей позиции с номером index
+    const HistoryNode* getVariation(size_t index) const { return history.getVariation(index); } // Продолжения текущей позиции
+    size_t getPly() const { return history.getPly(); } // Номер текущего полухода
+
     // Методы для сохранения/загрузки игры
     bool saveGame(const std::string& filename) const;
     bool loadGame(const std::string& filename);
@@ -23,28 +23,73 @@ Position ChessGame::parsePosition(const std::string& input) const {
 void ChessGame::printHelp() const {
     std::cout << "Команды\n"
         << "move <откуда> <куда> - Переместить фигуру (Пример: move e2 e4)\n"
+        << "undo                 - Отменить последний ход\n"
+        << "redo                 - Повторить отмененный ход\n"
+        << "goto <полуход>       - Перейти к позиции после полухода (0 - начало партии)\n"
+        << "variations           - Показать продолжения текущей позиции\n"
+        << "variation <номер>    - Перейти к продолжению с указанным номером\n"
         << "save <имя файла>     - Сохранение игры\n"
         << "load <имя файла>     - Загрузка сохранения\n"
         << "help                 - Показать справку\n"
         << "exit                 - Выход из игры\n";
 }
 
+// Запуск фонового анализа текущей позиции, пока игрок вводит команду
+void ChessGame::startAnalysis() {
+    analysisCancelled = false;
+    analysisDone = false;
+    analysisThread = std::thread([this]() {
+        analysisDone = board.analyzePosition(analysis, analysisCancelled);
+    });
+}
+
+// Остановка фонового анализа. После возврата доской снова владеет только основной поток
+void ChessGame::stopAnalysis() {
+    if (!analysisThread.joinable()) return;
+    analysisCancelled = true;
+    analysisThread.join();
+}
+
+ChessGame::~ChessGame() {
+    stopAnalysis();
+}
+
 // Основной игровой цикл
 void ChessGame::run() {
     std::cout << "Добро пожаловать в шахматы!\n";
     printHelp();
 
     std::string input;
-    while (!board.isGameOver()) {
+    while (true) {
         board.printBoard();
+
+        // После мата партию можно только просматривать
+        if (board.isGameOver()) {
+            std::cout << "Игра окончена. Для просмотра партии используйте undo, redo, goto и variations\n";
+        }
         std::cout << (board.getCurrentTurn() == Color::WHITE ? "White" : "Black") << "'s Ход: ";
-        std::getline(std::cin, input);
+
+        // Пока игрок думает, анализируем позицию в фоне
+        startAnalysis();
+        if (!std::getline(std::cin, input)) {
+            stopAnalysis();
+            break; // Ввод закончился
+        }
 
         std::istringstream iss(input);
         std::string command;
         iss >> command;
 
+        // Готовый анализ используем для хода, незавершенный прерываем
+        bool analysisReady = command == "move" && analysisDone;
+        stopAnalysis();
+
         if (command == "move") {
+            if (board.isGameOver()) {
+                std::cout << "Игра окончена, ходы недоступны\n";
+                continue;
+            }
+
             std::string fromStr, toStr;
             iss >> fromStr >> toStr;
 
@@ -57,11 +102,50 @@ void ChessGame::run() {
                 continue;
             }
 
-            // Пытаемся выполнить ход
-            if (!board.movePiece(from, to)) {
+            // Пытаемся выполнить ход: по готовому анализу сразу, иначе с полной проверкой
+            bool moved;
+            if (analysisReady) {
+                const MoveInfo* move = analysis.findMove(from, to);
+                moved = move != nullptr && board.applyMove(analysis, *move);
+            }
+            else {
+                moved = board.movePiece(from, to);
+            }
+            if (!moved) {
                 std::cout << "Недопустимый ход\n";
             }
         }
+        else if (command == "undo") {
+            if (!board.undoMove()) {
+                std::cout << "Нет ходов для отмены\n";
+            }
+        }
+        else if (command == "redo") {
+            if (!board.redoMove()) {
+                std::cout << "Нет ходов для повтора\n";
+            }
+        }
+        else if (command == "goto") {
+            size_t ply;
+            if (!(iss >> ply) || !board.goToPly(ply)) {
+                std::cout << "Такого полухода нет в истории партии\n";
+            }
+        }
+        else if (command == "variations") {
+            const HistoryNode* variation = board.getVariation(0);
+            if (!variation) {
+                std::cout << "У позиции нет продолжений\n";
+            }
+            for (size_t i = 0; variation; variation = board.getVariation(++i)) {
+                std::cout << i + 1 << ". " << variation->from.toString() << " " << variation->to.toString() << "\n";
+            }
+        }
+        else if (command == "variation") {
+            size_t number;
+            if (!(iss >> number) || number == 0 || !board.goToVariation(number - 1)) {
+                std::cout << "Такого продолжения нет\n";
+            }
+        }
         else if (command == "save") {
             std::string filename;
             iss >> filename;
@@ -88,12 +172,6 @@ void ChessGame::run() {
             std::cout << "Неизвестная команда. Введите 'help' для справки.\n";
         }
     }
-
-    // Если игра закончилась (мат), выводим финальное сообщение
-    if (board.isGameOver()) {
-        board.printBoard();
-        std::cout << "Игра окончена\n";
-    }
 }
 
 // Сохранение игры в файл
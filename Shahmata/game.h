@@ -3,17 +3,29 @@
 
 #include "chess.h"
 #include <string>
+#include <thread>
+#include <atomic>
 
 // Класс для управления игровым процессом
 class ChessGame {
 private:
     ChessBoard board; // Шахматная доска
 
+    // Фоновый анализ позиции, пока игрок обдумывает ход
+    PositionAnalysis analysis; // Результат анализа текущей позиции
+    std::thread analysisThread; // Поток анализа
+    std::atomic<bool> analysisCancelled{ false }; // Флаг прерывания анализа
+    std::atomic<bool> analysisDone{ false }; // Анализ завершен и результат готов
+
     // Вспомогательные методы
     Position parsePosition(const std::string& input) const; // Преобразование строки в позицию
     void printHelp() const; // Вывод справки по командам
+    void startAnalysis(); // Запуск фонового анализа текущей позиции
+    void stopAnalysis(); // Прерывание анализа и ожидание завершения потока
 
 public:
+    ~ChessGame();
+
     void run(); // Основной игровой цикл
     void saveGame(const std::string& filename) const; // Сохранение игры
     bool loadGame(const std::string& filename);  // Загрузка игры